@@ -161,6 +161,9 @@
 #define HZ 1024
 #define NCR5380_PIO_CHUNK_SIZE		256
 
+#define SAM_STAT_GOOD            0x00
+#define SAM_STAT_CHECK_CONDITION 0x02
+
 #define ABORT_TASK_SET      0x06
 #define ABORT               ABORT_TASK_SET
 
@@ -5,6 +5,12 @@
 
 #include "ncr5380.h"
 
+// Reports sizeof(NCR5380) at build time without failing it: the deprecation warning names the template argument.
+template <size_t N> struct NCR5380_instance_size_is {
+  __attribute__((deprecated("informational only, the template argument is sizeof(NCR5380) in bytes"))) static void report() {}
+};
+static inline void NCR5380_report_instance_size() { NCR5380_instance_size_is<sizeof(NCR5380)>::report(); }
+
 //Constructor sets the pins to use for the NCR5380 connection
 NCR5380::NCR5380(int cs_, int drq, int irq, int ior_, int ready, int dack_, int eop_, int reset_, int iow_, int a0,
                  int a1, int a2, int d0, int d1, int d2, int d3, int d4, int d5, int d6, int d7)
@@ -47,7 +53,7 @@ bool NCR5380::NCR5380_poll_politely2(int reg1, byte bit1, byte val1, int reg2, b
 }
 
 bool NCR5380::NCR5380_arbitrate() {
-  if (loggingEnabled) { Serial.print("Trying to arbitrate. ID=");Serial.print(scsiId);Serial.print("\n"); }
+  if (loggingEnabled) { Serial.print(F("Trying to arbitrate. ID="));Serial.print(scsiId);Serial.print('\n'); }
   //Set the phase bits to 0, otherwise the NCR5380 won't drive the data bus during SELECTION.
   NCR5380_write(TARGET_COMMAND_REG, 0);
   NCR5380_write(OUTPUT_DATA_REG, ID_MASK);
@@ -55,7 +61,7 @@ bool NCR5380::NCR5380_arbitrate() {
   // Wait for BUS FREE phase
   bool ok = NCR5380_poll_politely2(MODE_REG, MR_ARBITRATE, 0, INITIATOR_COMMAND_REG, ICR_ARBITRATION_PROGRESS, ICR_ARBITRATION_PROGRESS);
   if (!ok) {
-    if (loggingEnabled) { Serial.print("Arbitration timeout\n"); }
+    if (loggingEnabled) { Serial.print(F("Arbitration timeout\n")); }
     return false;
   }
   //Check for lost arbitration
@@ -63,12 +69,12 @@ bool NCR5380::NCR5380_arbitrate() {
       (NCR5380_read(CURRENT_SCSI_DATA_REG) & ID_HIGHER_MASK) ||
       (NCR5380_read(INITIATOR_COMMAND_REG) & ICR_ARBITRATION_LOST))
   {
-    if (loggingEnabled) { Serial.print("Lost arbitration. deasserting MR_ARBITRATE\n"); }
+    if (loggingEnabled) { Serial.print(F("Lost arbitration. deasserting MR_ARBITRATE\n")); }
     return false;
   }
   //After/during arbitration, BSY should be asserted.
   NCR5380_write(INITIATOR_COMMAND_REG, ICR_ASSERT_SEL | ICR_ASSERT_BSY);
-  if (loggingEnabled) { Serial.print("Won arbitration\n"); }
+  if (loggingEnabled) { Serial.print(F("Won arbitration\n")); }
   delay(1);
   return true;
 }
@@ -87,11 +93,11 @@ bool NCR5380::NCR5380_select(int targetId) {
   //Reset BSY
   NCR5380_write(INITIATOR_COMMAND_REG, ICR_ASSERT_DATA | ICR_ASSERT_ATN | ICR_ASSERT_SEL);
   delay(1);
-  if (loggingEnabled) { Serial.print("Selecting target ");Serial.print(targetId);Serial.print("\n"); }
+  if (loggingEnabled) { Serial.print(F("Selecting target "));Serial.print(targetId);Serial.print('\n'); }
   // TODO: SCSI spec call for a 250ms timeout for actual selection, so make this wait up to 250ms.
   bool ok = NCR5380_poll_politely(STATUS_REG, SR_BSY, SR_BSY);
   if (!ok) {
-    if (loggingEnabled) { Serial.print("Selection problem?\n"); }
+    if (loggingEnabled) { Serial.print(F("Selection problem?\n")); }
     return false;
   }
   delay(1);
@@ -103,11 +109,11 @@ bool NCR5380::NCR5380_select(int targetId) {
   //Wait for start of REQ/ACK handshake
   ok = NCR5380_poll_politely(STATUS_REG, SR_REQ, SR_REQ);
   if (!ok) {
-    if (loggingEnabled) { Serial.print("Select: REQ timeout\n"); }
+    if (loggingEnabled) { Serial.print(F("Select: REQ timeout\n")); }
     NCR5380_write(INITIATOR_COMMAND_REG, 0);
     return false;
   }
-  if (loggingEnabled) { Serial.print("Target ");Serial.print(targetId);Serial.print(" selected. Going into MESSAGE OUT phase.\n"); }
+  if (loggingEnabled) { Serial.print(F("Target "));Serial.print(targetId);Serial.print(F(" selected. Going into MESSAGE OUT phase.\n")); }
   byte tmp[3];
   tmp[0] = IDENTIFY(false, 0);
   int len = 1;
@@ -116,10 +122,10 @@ bool NCR5380::NCR5380_select(int targetId) {
   NCR5380_transfer_pio(&phase, &len, &msgptr);
   if (len) {
     NCR5380_write(INITIATOR_COMMAND_REG, 0);
-    if (loggingEnabled) { Serial.print("IDENTIFY message transfer failed\n"); }
+    if (loggingEnabled) { Serial.print(F("IDENTIFY message transfer failed\n")); }
     return false;
   }
-  if (loggingEnabled) { Serial.print("Nexus established.\n"); }
+  if (loggingEnabled) { Serial.print(F("Nexus established.\n")); }
   return true;
 }
 
@@ -159,117 +165,102 @@ byte NCR5380::NCR5380_wait_phase(byte phase) {
   return _phase;
 }
 
-bool NCR5380::NCR5380_inquiry(int scsiId) {
-  byte buf[256];
-  for (int i = 0; i < 256; i++) { buf[0] = 0; }
+// Device type names, indexed by the INQUIRY device type code. Kept in flash since they're only used for logging.
+static const char deviceType0[] PROGMEM = "(Direct access device (disk drive))\n";
+static const char deviceType1[] PROGMEM = "(Sequential access device (tape drive))\n";
+static const char deviceType2[] PROGMEM = "(Printer device)\n";
+static const char deviceType3[] PROGMEM = "(Processor device)\n";
+static const char deviceType4[] PROGMEM = "(Write-once device (WORM drive))\n";
+static const char deviceType5[] PROGMEM = "(CD-ROM device)\n";
+static const char deviceType6[] PROGMEM = "(Scanner device)\n";
+static const char deviceType7[] PROGMEM = "(Optical memory device (optical disk drive))\n";
+static const char deviceType8[] PROGMEM = "(Medium changer device (jukebox))\n";
+static const char deviceTypeUnknown[] PROGMEM = "(Unknown device type)\n";
+static const char *const deviceTypeNames[] PROGMEM = {
+  deviceType0, deviceType1, deviceType2, deviceType3, deviceType4, deviceType5, deviceType6, deviceType7, deviceType8
+};
+#define NUM_DEVICE_TYPE_NAMES (sizeof(deviceTypeNames) / sizeof(deviceTypeNames[0]))
+
+int NCR5380::inquiry(int targetId, byte *buf, int bufLen) { return NCR5380_inquiry(targetId, buf, bufLen); }
+
+void NCR5380::NCR5380_print_field(const __FlashStringHelper *label, const char *field, int len) {
+  Serial.print(label);
+  if (field) {
+    for (int i = 0; i < len; i++) { Serial.print(field[i]); }
+  } else {
+    Serial.print(F("(not returned)"));
+  }
+  Serial.print('\n');
+}
+
+// Sends INQUIRY to the target and leaves the raw response in buf. Returns the number of bytes received, or 0 on
+// failure, including when the target doesn't finish with GOOD status and COMMAND COMPLETE. bufLen must be at least
+// INQUIRY_MIN_LEN. Wrap buf in an InquiryData to pick fields out of it.
+int NCR5380::NCR5380_inquiry(int scsiId, byte *buf, int bufLen) {
+  if (bufLen < INQUIRY_MIN_LEN) {
+    if (loggingEnabled) { Serial.print(F("Inquiry buffer too small\n")); }
+    return 0;
+  }
+  if (bufLen > 255) { bufLen = 255; }  // Allocation length is a single byte in the 6-byte CDB
   int count = 0;
   bool ok = NCR5380_arbitrate();
   if (!ok) {
-    if (loggingEnabled) { Serial.print("arbitrate()=");Serial.print(ok);Serial.print("\n"); }
-    return false;
+    if (loggingEnabled) { Serial.print(F("arbitrate()="));Serial.print(ok);Serial.print('\n'); }
+    return 0;
   }
   ok = NCR5380_select(scsiId);
   if (!ok) {
-    if (loggingEnabled) { Serial.print("select()=");Serial.print(ok);Serial.print("\n"); }
-    return false;
+    if (loggingEnabled) { Serial.print(F("select()="));Serial.print(ok);Serial.print('\n'); }
+    return 0;
   }
   byte mm[8];
   mm[0] = 0x12;  // 0x12 = INQUIRY command
   mm[1] = 0;
   mm[2] = 0;
   mm[3] = 0;
-  mm[4] = 0xff;
+  mm[4] = bufLen;
   mm[5] = 0;
   byte *b = mm;
   ok = NCR5380_command(b, 6);
   if (!ok) {
-    if (loggingEnabled) { Serial.print("NCR5380_command()=");Serial.print(ok);Serial.print("\n"); }
-    return false;
+    if (loggingEnabled) { Serial.print(F("NCR5380_command()="));Serial.print(ok);Serial.print('\n'); }
+    return 0;
   }
-  int len = NCR5380_data_in_variable_length(buf, 256);
-  if (loggingEnabled) { Serial.print("Inquiry result size = ");Serial.print(len);Serial.print("\n"); }
+  // NCR5380_data_in_variable_length() returns the residual, not the number of bytes received.
+  int len = bufLen - NCR5380_data_in_variable_length(buf, bufLen);
+  if (loggingEnabled) { Serial.print(F("Inquiry result size = "));Serial.print(len);Serial.print('\n'); }
   if (len == 0) {
-    if (loggingEnabled) { Serial.print("NCR5380_data_in_variable_length() len zero!\n"); }
-    return false;
-  }
-  inquiryResult.peripheralQualifier = buf[0] >> 5;
-  inquiryResult.deviceTypeCode = buf[0] & 0x1F;
-  inquiryResult.removableMediaBit = (buf[1] >> 7) & 1;
-  inquiryResult.ansiScsiVersion = buf[2] & 0x07;
-  inquiryResult.additionnalDataLength = buf[4];
-  for (int i = 0; i < 8; i++) {
-    inquiryResult.vendorIdStr[i] = buf[8 + i];
-  }
-  inquiryResult.vendorIdStr[8] = 0;
-  for (int i = 0; i < 16; i++) {
-    inquiryResult.productIdStr[i] = buf[16 + i];
+    if (loggingEnabled) { Serial.print(F("NCR5380_data_in_variable_length() len zero!\n")); }
+    return 0;
   }
-  inquiryResult.productIdStr[16] = 0;
-  for (int i = 0; i < 4; i++) {
-    inquiryResult.productRevStr[i] = buf[32 + i];
-  }
-  inquiryResult.productRevStr[4] = 0;
-  for (int i = 0; i < 20; i++) {
-    inquiryResult.vendorSpecificInfoStr[i] = buf[36 + i];
-  }
-  inquiryResult.vendorSpecificInfoStr[20] = 0;
-  for (int i = 0; i < inquiryResult.additionnalDataLength; i++) {
-    inquiryResult.vendorSpecificData[i] = buf[96 + i];
-  }
-  inquiryResult.vendorSpecificData[inquiryResult.additionnalDataLength] = 0;
   if (loggingEnabled) {
-    Serial.print("---START INQUIRY RESULT RAW-----\n");
+    InquiryData inquiryResult(buf, len);
+    Serial.print(F("---START INQUIRY RESULT RAW-----\n"));
     for (int i = 0; i < len; i++) {
       char x = buf[i];
       Serial.print(x);
-      Serial.print(" ");
+      Serial.print(' ');
       if (i % 8 == 0) {
-        Serial.print("\n");
+        Serial.print('\n');
       }
     }
-    Serial.print("\n---END INQUIRY RESULT RAW-----\n");
-    Serial.print("---START INQUIRY RESULT PARSED-----\n");
-    Serial.print("Peripheral qualifier: (which LUN is actually connected) ");Serial.print(inquiryResult.peripheralQualifier);Serial.print("\n");
-    Serial.print("Device type code: ");Serial.print(inquiryResult.deviceTypeCode);Serial.print("\n");
-    switch(inquiryResult.deviceTypeCode) {
-      case 0x00:
-        Serial.print("(Direct access device (disk drive))\n");
-        break;
-      case 0x01:
-        Serial.print("(Sequential access device (tape drive))\n");
-        break;
-      case 0x02:
-        Serial.print("(Printer device)\n");
-        break;
-      case 0x03:
-        Serial.print("(Processor device)\n");
-        break;
-      case 0x04:
-        Serial.print("(Write-once device (WORM drive))\n");
-        break;
-      case 0x05:
-        Serial.print("(CD-ROM device)\n");
-        break;
-      case 0x06:
-        Serial.print("(Scanner device)\n");
-        break;
-      case 0x07:
-        Serial.print("(Optical memory device (optical disk drive))\n");
-        break;
-      case 0x08:
-        Serial.print("(Medium changer device (jukebox))\n");
-        break;
-      default:
-        Serial.print("(Unknown device type)\n");
+    Serial.print(F("\n---END INQUIRY RESULT RAW-----\n"));
+    Serial.print(F("---START INQUIRY RESULT PARSED-----\n"));
+    Serial.print(F("Peripheral qualifier: (which LUN is actually connected) "));Serial.print(inquiryResult.peripheralQualifier());Serial.print('\n');
+    Serial.print(F("Device type code: "));Serial.print(inquiryResult.deviceTypeCode());Serial.print('\n');
+    if (inquiryResult.deviceTypeCode() < NUM_DEVICE_TYPE_NAMES) {
+      Serial.print((const __FlashStringHelper *)pgm_read_ptr(&deviceTypeNames[inquiryResult.deviceTypeCode()]));
+    } else {
+      Serial.print((const __FlashStringHelper *)deviceTypeUnknown);
     }
-    Serial.print("Removable media device? ");if (inquiryResult.removableMediaBit) { Serial.print("yes\n"); } else { Serial.print("no\n"); }
-    Serial.print("Highest SCSI version supported: ");Serial.print(inquiryResult.ansiScsiVersion);Serial.print("\n");
-    Serial.print("Additional data length: ");Serial.print(inquiryResult.additionnalDataLength);Serial.print("\n");
-    Serial.print("Vendor ID string: ");Serial.print(inquiryResult.vendorIdStr);Serial.print("\n");
-    Serial.print("Product ID string: ");Serial.print(inquiryResult.productIdStr);Serial.print("\n");
-    Serial.print("Product revision string: ");Serial.print(inquiryResult.productRevStr);Serial.print("\n");
-    Serial.print("Vendor-specific info string: ");Serial.print(inquiryResult.vendorSpecificInfoStr);Serial.print("\n");
-    Serial.print("---END INQUIRY RESULT PARSED-----\n");
+    Serial.print(F("Removable media device? "));if (inquiryResult.removableMediaBit()) { Serial.print(F("yes\n")); } else { Serial.print(F("no\n")); }
+    Serial.print(F("Highest SCSI version supported: "));Serial.print(inquiryResult.ansiScsiVersion());Serial.print('\n');
+    Serial.print(F("Additional data length: "));Serial.print(inquiryResult.additionalDataLength());Serial.print('\n');
+    NCR5380_print_field(F("Vendor ID string: "), inquiryResult.vendorId(), INQUIRY_VENDOR_ID_LEN);
+    NCR5380_print_field(F("Product ID string: "), inquiryResult.productId(), INQUIRY_PRODUCT_ID_LEN);
+    NCR5380_print_field(F("Product revision string: "), inquiryResult.productRev(), INQUIRY_PRODUCT_REV_LEN);
+    NCR5380_print_field(F("Vendor-specific info string: "), inquiryResult.vendorSpecificInfo(), INQUIRY_VENDOR_SPECIFIC_INFO_LEN);
+    Serial.print(F("---END INQUIRY RESULT PARSED-----\n"));
   }
   count = len;
   // Wait for status phase
@@ -277,45 +268,48 @@ bool NCR5380::NCR5380_inquiry(int scsiId) {
   // Get status
   len = 1;
   byte data[2];
-  byte *dd = *data;
+  byte *dd = data;
   NCR5380_transfer_pio(&phase, &len, &dd);
-  if (loggingEnabled) { Serial.print("Inquiry status = ");Serial.print(data[0]);Serial.print("\n"); }
+  if (loggingEnabled) { Serial.print(F("Inquiry status = "));Serial.print(data[0]);Serial.print('\n'); }
   // Wait for message phase
   phase = NCR5380_wait_phase(PHASE_MSGIN);
   // Get message
   len = 1;
   byte data2[2];
-  byte *dd2 = *data2;
+  byte *dd2 = data2;
   NCR5380_transfer_pio(&phase, &len, &dd2);
-  if (loggingEnabled) { Serial.print("Inquiry msg len = ");Serial.print(len);Serial.print("\n"); }
-  if (loggingEnabled) { Serial.print("Inquiry msg = ");Serial.print(data2[0]);Serial.print("\n"); }
+  if (loggingEnabled) { Serial.print(F("Inquiry msg len = "));Serial.print(len);Serial.print('\n'); }
+  if (loggingEnabled) { Serial.print(F("Inquiry msg = "));Serial.print(data2[0]);Serial.print('\n'); }
   if (data2[0] == COMMAND_COMPLETE) {
     // Accept message by clearing ACK
     NCR5380_write(INITIATOR_COMMAND_REG, ICR_BASE);
     //Restore phase bits to 0 so an interrupted selection, arbitration can resume.
     NCR5380_write(TARGET_COMMAND_REG, 0);
-    if (loggingEnabled) { Serial.print("COMMAND_COMPLETE\n"); }
-  } else if (data[0] == MESSAGE_REJECT) {
+    if (loggingEnabled) { Serial.print(F("COMMAND_COMPLETE\n")); }
+  } else if (data2[0] == MESSAGE_REJECT) {
     // Accept message by clearing ACK
     NCR5380_write(INITIATOR_COMMAND_REG, ICR_BASE);
-    if (loggingEnabled) { Serial.print("MESSAGE_REJECT\n"); }
-  } else if (data[0] == DISCONNECT) {
+    if (loggingEnabled) { Serial.print(F("MESSAGE_REJECT\n")); }
+  } else if (data2[0] == DISCONNECT) {
     // Accept message by clearing ACK
     NCR5380_write(INITIATOR_COMMAND_REG, ICR_BASE);
     //Restore phase bits to 0 so an interrupted selection, arbitration can resume.
     NCR5380_write(TARGET_COMMAND_REG, 0);
-    if (loggingEnabled) { Serial.print("DISCONNECT\n"); }
+    if (loggingEnabled) { Serial.print(F("DISCONNECT\n")); }
   } else {
     // Whatever else we get, see Linux implementation of NCR5380_information_transfer
     // Accept message by clearing ACK
     NCR5380_write(INITIATOR_COMMAND_REG, ICR_BASE);
   }
+  if (data[0] != SAM_STAT_GOOD || data2[0] != COMMAND_COMPLETE) { return 0; }
+  return count;
 }
 
 void NCR5380::test() {
-  bool ok = NCR5380_inquiry(5);
+  byte buf[INQUIRY_WITH_VENDOR_INFO_LEN];
+  bool ok = NCR5380_inquiry(5, buf, sizeof(buf)) > 0;
   if (!ok) {
-    Serial.print("NCR5380_inquiry()=");Serial.print(ok);Serial.print("\n");
+    Serial.print(F("NCR5380_inquiry()="));Serial.print(ok);Serial.print('\n');
     return;
   }
 }
@@ -329,15 +323,15 @@ bool NCR5380::NCR5380_transfer_pio(byte *phase, int *count, byte **data) {
   NCR5380_write(TARGET_COMMAND_REG, PHASE_SR_TO_TCR(p));
   do {// Wait for assertion of REQ, after which the phase bits will be valid
     if (!NCR5380_poll_politely(STATUS_REG, SR_REQ, SR_REQ)) break;
-    if (verboseLoggingEnabled) { Serial.print("REQ asserted\n"); }
+    if (verboseLoggingEnabled) { Serial.print(F("REQ asserted\n")); }
     byte statusRegPhase = NCR5380_read(STATUS_REG) & PHASE_MASK;
     if (statusRegPhase != p) { //Check for phase mismatch
       if (loggingEnabled) {
-        Serial.print("phase mismatch found=");
+        Serial.print(F("phase mismatch found="));
         Serial.print(statusRegPhase, HEX);
-        Serial.print(" expected=");
+        Serial.print(F(" expected="));
         Serial.print(p, HEX);
-        Serial.print("\n");
+        Serial.print('\n');
       }
       break;
     }
@@ -358,7 +352,7 @@ bool NCR5380::NCR5380_transfer_pio(byte *phase, int *count, byte **data) {
       NCR5380_write(INITIATOR_COMMAND_REG, ICR_ASSERT_ACK);
     }
     if (!NCR5380_poll_politely(STATUS_REG, SR_REQ, 0)) break;
-    if (verboseLoggingEnabled) { Serial.print("REQ negated, handshake complete\n"); }
+    if (verboseLoggingEnabled) { Serial.print(F("REQ negated, handshake complete\n")); }
     //We have several special cases to consider during REQ/ACK handshaking :
     //1.  We were in MSGOUT phase, and we are on the last byte of the message.  ATN must be dropped as ACK is dropped.
     //2.  We are in a MSGIN phase, and we are on the last byte of the message.  We must exit with ACK asserted, so that
@@ -369,7 +363,7 @@ bool NCR5380::NCR5380_transfer_pio(byte *phase, int *count, byte **data) {
       else { NCR5380_write(INITIATOR_COMMAND_REG, 0); }
     }
   } while (--c);
-  if (loggingEnabled) { Serial.print("residual ");Serial.print(c);Serial.print("\n"); }
+  if (loggingEnabled) { Serial.print(F("residual "));Serial.print(c);Serial.print('\n'); }
   *count = c;
   *data = d;
   tmp = NCR5380_read(STATUS_REG);
@@ -44,19 +44,65 @@ digitalWrite(_d6, (x >> 6) & 0x01);digitalWrite(_d7, (x >> 7) & 0x01);
 #define ID_MASK 1 << scsiId
 #define ID_HIGHER_MASK 0b11111111 << scsiId + 1
 
-// This doesn't cover all inquiry result data, just the fields I thought people would care about. Please add the rest
-// if you need them!
-struct InquiryData {
-    int peripheralQualifier;
-    int deviceTypeCode;
-    bool removableMediaBit;
-    int ansiScsiVersion;
-    int additionnalDataLength;
-    char vendorIdStr[9];
-    char productIdStr[17];
-    char productRevStr[5];
-    char vendorSpecificInfoStr[21];
-    char vendorSpecificData[128];
+// Byte offsets and lengths of the INQUIRY response fields we care about.
+#define INQUIRY_VENDOR_ID_OFFSET            8
+#define INQUIRY_VENDOR_ID_LEN               8
+#define INQUIRY_PRODUCT_ID_OFFSET           16
+#define INQUIRY_PRODUCT_ID_LEN              16
+#define INQUIRY_PRODUCT_REV_OFFSET          32
+#define INQUIRY_PRODUCT_REV_LEN             4
+#define INQUIRY_VENDOR_SPECIFIC_INFO_OFFSET 36
+#define INQUIRY_VENDOR_SPECIFIC_INFO_LEN    20
+#define INQUIRY_VENDOR_SPECIFIC_DATA_OFFSET 96
+#define INQUIRY_STANDARD_LEN                36
+// Smallest buffer that holds every scalar field, and the smallest inquiry() accepts.
+#define INQUIRY_MIN_LEN                     5
+// Standard data plus the vendor-specific info string.
+#define INQUIRY_WITH_VENDOR_INFO_LEN        (INQUIRY_VENDOR_SPECIFIC_INFO_OFFSET + INQUIRY_VENDOR_SPECIFIC_INFO_LEN)
+
+// Upper bound on sizeof(NCR5380), checked at build time. The actual size is printed as a compiler warning when
+// ncr5380.cpp is built.
+#define NCR5380_MAX_INSTANCE_SIZE 32
+
+// Reads INQUIRY fields on demand out of a raw response buffer owned by the caller, so nothing is copied. This doesn't
+// cover all inquiry result data, just the fields I thought people would care about. Please add the rest if you need
+// them! The string fields are fixed-width and space padded, not NUL-terminated; use copyString() to get a C string.
+// len is the number of valid bytes in buf (what inquiry() returned). Fields past len read as 0 / NULL.
+class InquiryData {
+public:
+    InquiryData(const byte *buf, int len) : _buf(buf), _len(len) {}
+    byte peripheralQualifier() const { return at(0) >> 5; }
+    byte deviceTypeCode() const { return at(0) & 0x1F; }
+    bool removableMediaBit() const { return (at(1) >> 7) & 1; }
+    byte ansiScsiVersion() const { return at(2) & 0x07; }
+    byte additionalDataLength() const { return at(4); }
+    const char *vendorId() const { return field(INQUIRY_VENDOR_ID_OFFSET, INQUIRY_VENDOR_ID_LEN); }
+    const char *productId() const { return field(INQUIRY_PRODUCT_ID_OFFSET, INQUIRY_PRODUCT_ID_LEN); }
+    const char *productRev() const { return field(INQUIRY_PRODUCT_REV_OFFSET, INQUIRY_PRODUCT_REV_LEN); }
+    const char *vendorSpecificInfo() const {
+        return field(INQUIRY_VENDOR_SPECIFIC_INFO_OFFSET, INQUIRY_VENDOR_SPECIFIC_INFO_LEN);
+    }
+    // Number of vendor-specific data bytes that actually made it into the buffer.
+    int vendorSpecificDataLength() const {
+        int end = min(_len, additionalDataLength() + 5);
+        return end > INQUIRY_VENDOR_SPECIFIC_DATA_OFFSET ? end - INQUIRY_VENDOR_SPECIFIC_DATA_OFFSET : 0;
+    }
+    const byte *vendorSpecificData() const {
+        return vendorSpecificDataLength() ? _buf + INQUIRY_VENDOR_SPECIFIC_DATA_OFFSET : NULL;
+    }
+    // Copies a fixed-width field into dst, which must hold len + 1 chars. Returns dst.
+    static char *copyString(char *dst, const char *field, int len) {
+        if (!field) { len = 0; }
+        for (int i = 0; i < len; i++) { dst[i] = field[i]; }
+        dst[len] = 0;
+        return dst;
+    }
+private:
+    const byte *_buf;
+    int _len;
+    byte at(int i) const { return i < _len ? _buf[i] : 0; }
+    // Returns NULL if the target sent back a short response that doesn't include the field.
+    const char *field(int offset, int len) const { return _len >= offset + len ? (const char *)_buf + offset : NULL; }
 };
 
 class NCR5380 {
@@ -68,31 +114,31 @@ public:
     void setVerboseLoggingEnabled(bool);
     void setScsiId(int);
     void test();
-    InquiryData inquiryResult;
+    int inquiry(int, byte *, int);
 private:
-    int _cs_;
-    int _drq;
-    int _irq;
-    int _ior_;
-    int _ready;
-    int _dack_;
-    int _eop_;
-    int _reset_;
-    int _iow_;
-    int _a0;
-    int _a1;
-    int _a2;
-    int _d0;
-    int _d1;
-    int _d2;
-    int _d3;
-    int _d4;
-    int _d5;
-    int _d6;
-    int _d7;
+    byte _cs_;
+    byte _drq;
+    byte _irq;
+    byte _ior_;
+    byte _ready;
+    byte _dack_;
+    byte _eop_;
+    byte _reset_;
+    byte _iow_;
+    byte _a0;
+    byte _a1;
+    byte _a2;
+    byte _d0;
+    byte _d1;
+    byte _d2;
+    byte _d3;
+    byte _d4;
+    byte _d5;
+    byte _d6;
+    byte _d7;
     bool loggingEnabled = false;
     bool verboseLoggingEnabled = false;
-    int scsiId = 7;
+    byte scsiId = 7;
     void NCR5380_write(byte, byte);
     byte NCR5380_read(byte);
     bool NCR5380_arbitrate();
@@ -103,8 +149,11 @@ private:
     bool NCR5380_command(byte *, int);
     bool NCR5380_data_in(byte *, int);
     int NCR5380_data_in_variable_length(byte *, int);
-    bool NCR5380_inquiry(int);
+    int NCR5380_inquiry(int, byte *, int);
+    void NCR5380_print_field(const __FlashStringHelper *, const char *, int);
     byte NCR5380_wait_phase(byte);
 };
 
+static_assert(sizeof(NCR5380) <= NCR5380_MAX_INSTANCE_SIZE, "NCR5380 instance grew past NCR5380_MAX_INSTANCE_SIZE");
+
 #endif
\ No newline at end of file